@@ -1,344 +1,27 @@
 #include <iostream>
-#include <fstream>
-#include <memory>
-#include <algorithm>
-#include <iterator>
 
 #include <unistd.h>
 
 #include "HepMC/GenEvent.h"
-#include "HepMC/GenRanges.h"
 
-#include "TTree.h"
-#include "TFile.h"
+#include "event_source.h"
+#include "root_tree_sink.h"
 
 void usage(char** argv) {
     std::cout << "Convert a hepmc2-file to a root tree.\n\n";
     std::printf("Usage: %s <input> [output] [options]\n", argv[0]);
+    std::cout << "<input>  hepmc2-file, .gz, named pipe or - for stdin.\n";
     std::cout << "Options:\n";
     std::cout << "  -h      Display this message and exit.\n";
     std::cout << "  -n <N>  Process only the first N events.\n";
     std::cout << "  -f      Fast/flat mode (no child/vertex/..).\n";
-}
-
-template<typename T, typename F>
-auto find_idx(const T& v, F&& pred) {
-    const auto& pos = std::find_if(std::begin(v), std::end(v), pred);
-    return std::distance(std::begin(v), pos);
-}
-
-struct Event {
-    int number{0};
-    int n_particles{0};
-    int n_vertices{0};
-    int mpi{0};
-    double scale{0.};
-    double alphaQCD{0.};
-    double alphaQED{0.};
-    int id1{0};
-    int id2{0};
-    int pdf_id1{0};
-    int pdf_id2{0};
-    double x1{0.};
-    double x2{0.};
-    double scalePDF{0.};
-    double pdf1{0.};
-    double pdf2{0.};
-
-    std::vector<double> weights{};
-
-    std::vector<int> pdg_id{};
-    std::vector<int> barcode{};
-    std::vector<int> status{};
-    std::vector<int> is_final_state{};
-    std::vector<int> prod_vtx{};
-    std::vector<int> decay_vtx{};
-    std::vector<int> prod_vtx_barcode{};
-    std::vector<int> decay_vtx_barcode{};
-
-    std::vector<std::vector<int>> children{};
-    std::vector<std::vector<int>> parents{};
-
-    std::vector<double> pt{};
-    std::vector<double> e{};
-    std::vector<double> m{};
-    std::vector<double> eta{};
-    std::vector<double> phi{};
-
-    std::vector<int> vtx_barcode{};
-
-    std::vector<double> vtx_x{};
-    std::vector<double> vtx_y{};
-    std::vector<double> vtx_z{};
-    std::vector<double> vtx_t{};
-
-    std::vector<std::vector<int>> vtx_part_in_barcode{};
-    std::vector<std::vector<int>> vtx_part_out_barcode{};
-
-    std::vector<std::vector<int>> vtx_part_in{};
-    std::vector<std::vector<int>> vtx_part_out{};
-};
-
-struct Output {
-    std::unique_ptr<TFile> file{};
-    std::unique_ptr<TTree> tree{};
-    Event event{};
-};
-
-auto fill_particle(const HepMC::GenParticle& p, Event& event) {
-    event.pdg_id.push_back(p.pdg_id());
-    event.barcode.push_back(p.barcode());
-    event.status.push_back(p.status());
-    event.is_final_state.push_back((int)(p.status() == 1));
-
-    const auto& momentum = p.momentum();
-    event.pt.push_back(momentum.perp());
-    event.e.push_back(momentum.e());
-    event.m.push_back(momentum.m());
-    event.eta.push_back(momentum.eta());
-    event.phi.push_back(momentum.phi());
-
-    return event.pdg_id.size() - 1;
-}
-
-void fill_vertex(int i, const HepMC::GenVertex& v, Event& event) {
-    event.vtx_barcode[i] = v.barcode();
-
-    const auto& position = v.position();
-    event.vtx_x[i]       = position.x();
-    event.vtx_y[i]       = position.y();
-    event.vtx_z[i]       = position.z();
-    event.vtx_t[i]       = position.t();
-}
-
-void clear(Event& event) {
-    event.number      = 0;
-    event.n_particles = 0;
-    event.n_vertices  = 0;
-    event.mpi         = 0;
-    event.scale       = 0.;
-    event.alphaQCD    = 0.;
-    event.alphaQED    = 0.;
-    event.id1         = 0;
-    event.id2         = 0;
-    event.pdf_id1     = 0;
-    event.pdf_id2     = 0;
-    event.x1          = 0.;
-    event.x2          = 0.;
-    event.scalePDF    = 0.;
-    event.pdf1        = 0.;
-    event.pdf2        = 0.;
-
-    event.weights.clear();
-    event.pdg_id.clear();
-    event.barcode.clear();
-    event.status.clear();
-    event.is_final_state.clear();
-    event.prod_vtx.clear();
-    event.decay_vtx.clear();
-    event.prod_vtx_barcode.clear();
-    event.decay_vtx_barcode.clear();
-
-    event.children.clear();
-    event.parents.clear();
-
-    event.pt.clear();
-    event.e.clear();
-    event.m.clear();
-    event.eta.clear();
-    event.phi.clear();
-
-    event.vtx_barcode.clear();
-
-    event.vtx_x.clear();
-    event.vtx_y.clear();
-    event.vtx_z.clear();
-    event.vtx_t.clear();
-
-    event.vtx_part_in.clear();
-    event.vtx_part_out.clear();
-    event.vtx_part_in_barcode.clear();
-    event.vtx_part_out_barcode.clear();
-}
-
-void make_output(const std::string& fn_output, Output& output, bool flat) {
-    output.file =
-            std::unique_ptr<TFile>(TFile::Open(fn_output.c_str(), "RECREATE"));
-    output.file->cd();
-    output.tree = std::make_unique<TTree>("nominal", "nominal");
-
-    output.tree->Branch("event_number", &output.event.number);
-    output.tree->Branch("n_particles",  &output.event.n_particles);
-    output.tree->Branch("n_vertices",   &output.event.n_vertices);
-    output.tree->Branch("mpi",          &output.event.mpi);
-    output.tree->Branch("scale",        &output.event.scale);
-    output.tree->Branch("alphaQCD",     &output.event.alphaQCD);
-    output.tree->Branch("alphaQED",     &output.event.alphaQED);
-    output.tree->Branch("id1",          &output.event.id1);
-    output.tree->Branch("id2",          &output.event.id2);
-    output.tree->Branch("pdf_id1",      &output.event.pdf_id1);
-    output.tree->Branch("pdf_id2",      &output.event.pdf_id2);
-    output.tree->Branch("x1",           &output.event.x1);
-    output.tree->Branch("x2",           &output.event.x2);
-    output.tree->Branch("scalePDF",     &output.event.scalePDF);
-    output.tree->Branch("pdf1",         &output.event.pdf1);
-    output.tree->Branch("pdf2",         &output.event.pdf2);
-
-    output.tree->Branch("weights",           &output.event.weights);
-    output.tree->Branch("pdg_id",            &output.event.pdg_id);
-    output.tree->Branch("barcode",           &output.event.barcode);
-    output.tree->Branch("status",            &output.event.status);
-    output.tree->Branch("is_final_state",    &output.event.is_final_state);
-
-    if (!flat) {
-        output.tree->Branch("prod_vtx",          &output.event.prod_vtx);
-        output.tree->Branch("decay_vtx",         &output.event.decay_vtx);
-        output.tree->Branch("prod_vtx_barcode",  &output.event.prod_vtx_barcode);
-        output.tree->Branch("decay_vtx_barcode", &output.event.decay_vtx_barcode);
-        output.tree->Branch("children",          &output.event.children);
-        output.tree->Branch("parents",           &output.event.parents);
-    }
-
-    output.tree->Branch("pt",  &output.event.pt);
-    output.tree->Branch("e",   &output.event.e);
-    output.tree->Branch("m",   &output.event.m);
-    output.tree->Branch("eta", &output.event.eta);
-    output.tree->Branch("phi", &output.event.phi);
-
-    if (!flat) {
-        output.tree->Branch("vtx_barcode", &output.event.vtx_barcode);
-        output.tree->Branch("vtx_x",       &output.event.vtx_x);
-        output.tree->Branch("vtx_y",       &output.event.vtx_y);
-        output.tree->Branch("vtx_z",       &output.event.vtx_z);
-        output.tree->Branch("vtx_t",       &output.event.vtx_t);
-
-        output.tree->Branch(
-                "vtx_part_in_barcode",      &output.event.vtx_part_in_barcode);
-        output.tree->Branch(
-                "vtx_part_out_barcode",     &output.event.vtx_part_out_barcode);
-        output.tree->Branch("vtx_part_in",  &output.event.vtx_part_in);
-        output.tree->Branch("vtx_part_out", &output.event.vtx_part_out);
-    }
-}
-
-int process_evt(const HepMC::GenEvent& evt, Event& event, bool flat) {
-
-    event.number      = evt.event_number();
-    event.n_particles = evt.particles_size();
-    event.n_vertices  = evt.vertices_size();
-    event.mpi         = evt.mpi();
-    event.scale       = evt.event_scale();
-    event.alphaQCD    = evt.alphaQCD();
-    event.alphaQED    = evt.alphaQED();
-
-    const auto& pdf_info = evt.pdf_info();
-    if (pdf_info != nullptr) {
-        event.id1      = pdf_info->id1();
-        event.id2      = pdf_info->id2();
-        event.pdf_id1  = pdf_info->pdf_id1();
-        event.pdf_id2  = pdf_info->pdf_id2();
-        event.x1       = pdf_info->x1();
-        event.x2       = pdf_info->x2();
-        event.scalePDF = pdf_info->scalePDF();
-        event.pdf1     = pdf_info->pdf1();
-        event.pdf2     = pdf_info->pdf2();
-    }
-
-    const auto& weights = evt.weights();
-    for (const auto& w : weights) {
-        event.weights.push_back(w);
-    }
-
-    const auto& particles = evt.particle_range();
-    const auto& vertices  = evt.vertex_range();
-
-    auto n_particles =
-            std::distance(std::begin(particles), std::end(particles));
-    auto n_vertices = std::distance(std::begin(vertices), std::end(vertices));
-
-    assert(n_particles >= 0);
-    assert(n_vertices >= 0);
-
-    event.children.resize(n_particles);
-    event.parents.resize(n_particles);
-    event.prod_vtx.resize(n_particles);
-    event.decay_vtx.resize(n_particles);
-    event.prod_vtx_barcode.resize(n_particles);
-    event.decay_vtx_barcode.resize(n_particles);
-
-    event.vtx_barcode.resize(n_vertices);
-    event.vtx_x.resize(n_vertices);
-    event.vtx_y.resize(n_vertices);
-    event.vtx_z.resize(n_vertices);
-    event.vtx_t.resize(n_vertices);
-    event.vtx_part_in_barcode.resize(n_vertices);
-    event.vtx_part_out_barcode.resize(n_vertices);
-    event.vtx_part_in.resize(n_vertices);
-    event.vtx_part_out.resize(n_vertices);
-
-    for (const auto& p : particles) {
-        auto ip = fill_particle(*p, event);
-        assert(ip < (unsigned)n_particles);
-
-        const auto& prod_vtx = p->production_vertex();
-        if (prod_vtx != nullptr && !flat) {
-            event.prod_vtx_barcode[ip] = prod_vtx->barcode();
-
-            auto iv = find_idx(vertices, [&prod_vtx](const auto& v) {
-                    return prod_vtx->barcode() == v->barcode();
-                    });
-            assert(iv >= 0);
-            assert(iv < n_vertices);
-
-            fill_vertex(iv, *prod_vtx, event);
-
-            event.prod_vtx[ip] = iv;
-            event.vtx_part_out_barcode[iv].push_back(p->barcode());
-            event.vtx_part_out[iv].push_back(ip);
-        } else {
-            event.prod_vtx[ip] = -1;
-        }
-
-        const auto& end_vtx = p->end_vertex();
-        if (end_vtx != nullptr && !flat) {
-            event.decay_vtx_barcode[ip] = end_vtx->barcode();
-
-            auto iv = find_idx(vertices, [&end_vtx](const auto& v) {
-                    return end_vtx->barcode() == v->barcode();
-                    });
-            assert(iv >= 0);
-            assert(iv < n_vertices);
-
-            fill_vertex(iv, *end_vtx, event);
-
-            event.decay_vtx[ip] = iv;
-            event.vtx_part_in_barcode[iv].push_back(p->barcode());
-            event.vtx_part_in[iv].push_back(ip);
-        } else {
-            event.decay_vtx[ip] = -1;
-        }
-    }
-
-    if (!flat) {
-        for (size_t ip = 0; ip < (unsigned)n_particles; ++ip) {
-            const auto iv_prod  = event.prod_vtx[ip];
-            const auto iv_decay = event.decay_vtx[ip];
-
-            if (iv_decay > -1) {
-                for (const auto& child : event.vtx_part_out[iv_decay]) {
-                    event.children[ip].push_back(child);
-                }
-            }
-
-            if (iv_prod > -1) {
-                for (const auto& parent : event.vtx_part_in[iv_prod]) {
-                    event.parents[ip].push_back(parent);
-                }
-            }
-        }
-    }
-
-    return 0;
+    std::cout << "  -t      Store first-parent Euler-tour intervals (tour_in/tour_out),\n";
+    std::cout << "          not with -f.\n";
+    std::cout << "  -c <N>  Checkpoint the output every N events.\n";
+    std::cout << "  -r      Resume from the last checkpoint in [output].\n";
+    std::cout << "  -w      Store weights as a fixed-width float array.\n";
+    std::cout << "  -b <N>  Number of read-ahead buffers for pipes (default: 16).\n";
+    std::cout << "  -s <N>  Size of each pipe buffer in KiB (default: 1024).\n";
 }
 
 int main(int argc, char** argv) {
@@ -349,8 +32,11 @@ int main(int argc, char** argv) {
 
     int c;
     int maxevents = -1;
-    bool flat = false;
-    while ((c = getopt(argc, argv, "hn:f")) != -1) {
+    int checkpoint_every = 0;
+    int n_buffers = 16;
+    int buffer_kib = 1024;
+    RootTreeOptions options{};
+    while ((c = getopt(argc, argv, "hn:ftc:rwb:s:")) != -1) {
         switch (c) {
             case 'h':
                 {
@@ -365,7 +51,37 @@ int main(int argc, char** argv) {
                 break;
             case 'f':
                 {
-                    flat = true;
+                    options.flat = true;
+                }
+                break;
+            case 't':
+                {
+                    options.euler_tour = true;
+                }
+                break;
+            case 'c':
+                {
+                    checkpoint_every = atoi(optarg);
+                }
+                break;
+            case 'r':
+                {
+                    options.resume = true;
+                }
+                break;
+            case 'w':
+                {
+                    options.float_weights = true;
+                }
+                break;
+            case 'b':
+                {
+                    n_buffers = atoi(optarg);
+                }
+                break;
+            case 's':
+                {
+                    buffer_kib = atoi(optarg);
                 }
                 break;
             default:
@@ -374,6 +90,16 @@ int main(int argc, char** argv) {
         }
     }
 
+    if (n_buffers < 2 || buffer_kib < 1) {
+        std::cerr << "-b must be at least 2 and -s at least 1." << '\n';
+        return 2;
+    }
+
+    if (options.flat && options.euler_tour) {
+        std::cerr << "-t cannot be used in flat mode (-f)." << '\n';
+        return 2;
+    }
+
     std::string fn_input  = argv[optind];
     std::string fn_output = "out.root";
     if (argc >= optind+2) {
@@ -384,37 +110,83 @@ int main(int argc, char** argv) {
     std::cout << "Out: " << fn_output << '\n';
     std::cout << "Processing " << maxevents << " events.\n";
 
-    Output output{};
-    make_output(fn_output, output, flat);
+    options.checkpoints = checkpoint_every > 0;
+    RootTreeSink sink(fn_output, options);
+    if (!sink.is_open()) {
+        std::cerr << "Could not open " << fn_output << '\n';
+        return 1;
+    }
+
+    std::streamoff input_offset = 0;
+    int ievent = 0;
+    if (sink.resumed()) {
+        if (!sink.mismatch().empty()) {
+            std::cerr << "Cannot resume " << fn_output << ": the "
+                      << sink.mismatch() << " option differs from the run"
+                      << " that created it." << '\n';
+            return 3;
+        }
+
+        input_offset = sink.last_checkpoint();
+        if (input_offset < 0) {
+            std::cerr << "No checkpoint found in " << fn_output << '\n';
+            return 3;
+        }
+
+        ievent = sink.entries();
+        std::cout << "Resuming after " << ievent << " events at byte "
+                  << input_offset << ".\n";
+    }
+
+    if (input_offset > 0 && is_pipe(fn_input)) {
+        std::cerr << "Cannot resume when reading from stdin or a pipe." << '\n';
+        return 3;
+    }
+
+    auto source = open_event_source(fn_input, input_offset,
+            (std::size_t)buffer_kib << 10, n_buffers);
+    if (source == nullptr) {
+        std::cerr << "Could not open " << fn_input << '\n';
+        return 1;
+    }
 
-    std::ifstream is(fn_input);
     HepMC::GenEvent evt;
-    int ievent   = 0;
-    while (is) {
+    while (maxevents < 0 || ievent < maxevents) {
 
-        if (maxevents >= 0 && ievent >= maxevents) {
-            break;
+        if (ievent % 500 == 0) {
+            std::cout << "ievent " << ievent << "  ("
+                      << (source->offset() >> 20) << " MiB)";
+            source->progress(std::cout);
+            std::cout << '\n';
         }
 
-        evt.read(is);
+        if (!source->read(evt)) {
+            break;
+        }
 
         if (ievent == 0) {
             evt.write_units();
         }
 
-        if (ievent % 500 == 0) {
-            std::cout << "ievent " << ievent << '\n';
-        }
+        sink.write(evt, source->weight_names());
+        ++ievent;
 
-        if (evt.is_valid()) {
-            clear(output.event);
-            process_evt(evt, output.event, flat);
-            output.tree->Fill();
-            ++ievent;
+        if (checkpoint_every > 0 && ievent % checkpoint_every == 0) {
+            sink.checkpoint(source->offset());
         }
     }
     std::cout << ievent << " events processed." << '\n';
-    output.file->Write();
+    source->report(std::cout);
+    sink.report(std::cout);
+
+    sink.checkpoint(source->offset());
+    sink.close();
+
+    if (source->failed()) {
+        std::cerr << "Reading " << fn_input << " failed, the output is "
+                  << "incomplete." << '\n';
+        return 4;
+    }
 
     return 0;
 }
@@ -0,0 +1,166 @@
+#ifndef EVENT_H_
+#define EVENT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HepMC/GenEvent.h"
+
+#include "TTree.h"
+#include "TFile.h"
+
+// Flattened representation of a HepMC::GenEvent, one entry of the
+// "nominal" tree written by hepmc2root.
+struct Event {
+    int number{0};
+    int n_particles{0};
+    int n_vertices{0};
+    int mpi{0};
+    double scale{0.};
+    double alphaQCD{0.};
+    double alphaQED{0.};
+    int id1{0};
+    int id2{0};
+    int pdf_id1{0};
+    int pdf_id2{0};
+    double x1{0.};
+    double x2{0.};
+    double scalePDF{0.};
+    double pdf1{0.};
+    double pdf2{0.};
+
+    std::vector<double> weights{};
+
+    std::vector<int> pdg_id{};
+    std::vector<int> barcode{};
+    std::vector<int> status{};
+    std::vector<int> is_final_state{};
+    std::vector<int> prod_vtx{};
+    std::vector<int> decay_vtx{};
+    std::vector<int> prod_vtx_barcode{};
+    std::vector<int> decay_vtx_barcode{};
+
+    std::vector<std::vector<int>> children{};
+    std::vector<std::vector<int>> parents{};
+
+    std::vector<int> last_copy{};
+    std::vector<int> first_copy{};
+    std::vector<int> root_ancestor{};
+    std::vector<int> depth{};
+    std::vector<int> tour_in{};
+    std::vector<int> tour_out{};
+
+    std::vector<double> pt{};
+    std::vector<double> e{};
+    std::vector<double> m{};
+    std::vector<double> eta{};
+    std::vector<double> phi{};
+
+    std::vector<int> vtx_barcode{};
+
+    std::vector<double> vtx_x{};
+    std::vector<double> vtx_y{};
+    std::vector<double> vtx_z{};
+    std::vector<double> vtx_t{};
+
+    std::vector<std::vector<int>> vtx_part_in_barcode{};
+    std::vector<std::vector<int>> vtx_part_out_barcode{};
+
+    std::vector<std::vector<int>> vtx_part_in{};
+    std::vector<std::vector<int>> vtx_part_out{};
+
+    // Fixed-width alternative to `weights`, see RootTreeOptions.
+    std::vector<float> weight_values{};
+};
+
+// Running sums of every event weight, written to the "weight_summary" tree
+// with one entry per weight so that cross sections can be normalised
+// without a second pass over the events.
+struct WeightSummary {
+    std::vector<std::string> names{};
+    std::vector<double> sum_w{};
+    std::vector<double> sum_w2{};
+    std::vector<Long64_t> n{};
+};
+
+struct RootTreeOptions {
+    // Fast/flat mode (no child/vertex/..).
+    bool flat{false};
+    // Store Euler-tour intervals, see fill_ancestry.
+    bool euler_tour{false};
+    // Continue filling the tree of an existing output.
+    bool resume{false};
+    // Only let checkpoint() write the tree header, see the RootTreeSink
+    // constructor.
+    bool checkpoints{false};
+    // Store the weights as a fixed-width float array, sized by the first
+    // event, instead of a std::vector<double> per event.
+    bool float_weights{false};
+};
+
+struct Output {
+    std::unique_ptr<TFile> file{};
+    std::unique_ptr<TTree> tree{};
+    Event event{};
+    WeightSummary weights{};
+    // Events with more weights than the fixed-width "weights" branch.
+    Long64_t truncated_weights{0};
+    // Name of the first option in RootTreeOptions that differs from the run
+    // that created an existing tree, see make_output.
+    std::string mismatch{};
+};
+
+void clear(Event& event);
+
+// Precompute the decay chain of every particle so that downstream ancestry
+// queries become array lookups. Particles are visited once in topological
+// order (parents before children):
+//   last_copy/first_copy  last/first particle in the chain of same-pdg_id
+//                         children/parents (cf. find_last_child),
+//   root_ancestor/depth   particle without parents reached by following the
+//                         first parent, and the number of steps to it,
+//   tour_in/tour_out      Euler-tour interval over the tree formed by the
+//                         first parents: q descends from p iff
+//                         tour_in[p] <= tour_in[q] <= tour_out[p].
+void fill_ancestry(Event& event, bool euler_tour);
+
+int process_evt(const HepMC::GenEvent& evt, Event& event, bool flat,
+        bool euler_tour);
+
+// Store the weights of `evt` in output.event and add them to
+// output.weights, which takes new weights' names from `names` (or their
+// index). With `fixed`, the "weights" branch is booked as a float array on
+// the first event: later events with more weights are truncated and counted
+// in output.truncated_weights, with fewer are padded with zeros. The
+// summary always covers all weights.
+void fill_weights(const HepMC::GenEvent& evt,
+        const std::vector<std::string>& names, Output& output, bool fixed);
+
+// Write output.weights to the "weight_summary" tree, replacing the previous
+// one. This copy is for users only: resuming reads the summary stored by
+// checkpoint().
+void write_weight_summary(Output& output);
+
+// Open the output file and book the branches. When resuming, the tree of an
+// existing output is reused, its branches are pointed at output.event and
+// the weight summary and truncation count of its last checkpoint are read
+// back. Returns true if an existing tree was
+// found. The flat, euler_tour and float_weights options are stored in the
+// tree's user info; if they differ for an existing tree (or were never
+// stored), output.mismatch is set and no branches are booked. If the file
+// cannot be opened (e.g. an unrecoverable file), output.file is nullptr.
+bool make_output(const std::string& fn_output, Output& output,
+        const RootTreeOptions& options);
+
+// Store how far the input has been converted alongside the tree and flush
+// it to disk. The offset, the weight summary and output.truncated_weights
+// are kept in the tree's user info so that they are written atomically with
+// the tree header: an interrupted checkpoint cannot leave sums that cover
+// more events than the tree.
+void checkpoint(Output& output, Long64_t input_offset);
+
+// Returns the input offset of the last checkpoint, or -1 if there is none.
+Long64_t last_checkpoint(const Output& output);
+
+#endif /* EVENT_H_ */
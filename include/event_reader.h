@@ -0,0 +1,49 @@
+#ifndef EVENT_READER_H_
+#define EVENT_READER_H_
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HepMC/GenEvent.h"
+
+// Reads HepMC2 ascii events from a stream and recovers from malformed or
+// truncated events. The input is split into blocks starting at each `E `
+// line and every block is parsed in isolation, so a broken event can only
+// cost itself: it is skipped, its byte range is recorded and reading
+// continues with the next `E ` line.
+struct Reader {
+    std::istream* is{nullptr};
+    std::string header{};
+    std::string line{};
+    bool has_line{false};
+    std::streamoff line_offset{0};
+    std::streamoff offset{0};
+    bool first{true};
+    std::string text{};
+    std::stringstream buffer{};
+    // Weight names of the last event read, from its `N` line.
+    std::vector<std::string> weight_names{};
+
+    std::vector<std::pair<std::streamoff, std::streamoff>> skipped{};
+};
+
+// Read the HepMC header from `is` and, if `offset` is given, continue
+// reading events from that byte offset (see resume_offset).
+void open_reader(std::istream& is, Reader& reader, std::streamoff offset = 0);
+
+// Read the next well-formed event into `evt`, and its weight names into
+// reader.weight_names. Weights without a name are named by their index, as
+// HepMC does. Returns false once the input is exhausted.
+bool read_event(Reader& reader, HepMC::GenEvent& evt);
+
+// Byte offset of the first event not returned yet. Passing it to
+// open_reader continues reading from there.
+std::streamoff resume_offset(const Reader& reader);
+
+// Print the byte ranges that were skipped.
+void report(const Reader& reader, std::ostream& os);
+
+#endif /* EVENT_READER_H_ */
@@ -0,0 +1,91 @@
+#ifndef EVENT_SINK_H_
+#define EVENT_SINK_H_
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HepMC/GenEvent.h"
+#include "HepMC/IO_GenEvent.h"
+
+// Destination of HepMC events. Sinks may modify the events they are given,
+// see PruneFilter.
+class EventSink {
+public:
+    virtual ~EventSink() = default;
+
+    virtual void write(HepMC::GenEvent& evt) = 0;
+
+    // Write `evt` with the names of its weights, see
+    // EventSource::weight_names. Only sinks that store the names override
+    // this, the others ignore them.
+    virtual void write(HepMC::GenEvent& evt,
+            const std::vector<std::string>& weight_names);
+
+    // Write the first `n` events of `batch`, optionally with the weight
+    // names of each event (see EventSource::read_batch).
+    void write_batch(std::vector<HepMC::GenEvent>& batch, std::size_t n);
+    void write_batch(std::vector<HepMC::GenEvent>& batch, std::size_t n,
+            const std::vector<std::vector<std::string>>& weight_names);
+};
+
+// HepMC2 ascii output.
+class AsciiEventSink : public EventSink {
+public:
+    explicit AsciiEventSink(const std::string& filename);
+
+    // Does not take ownership, e.g. for std::cout.
+    explicit AsciiEventSink(std::ostream& os);
+
+    using EventSink::write;
+    void write(HepMC::GenEvent& evt) override;
+
+private:
+    std::unique_ptr<HepMC::IO_GenEvent> m_io{};
+};
+
+// HepMC2 ascii output split into files "<base>.0", "<base>.1", ... of
+// `events_per_file` events each. All events go to "<base>.0" if
+// events_per_file <= 0.
+class SplitEventSink : public EventSink {
+public:
+    SplitEventSink(const std::string& base, int events_per_file);
+
+    using EventSink::write;
+    void write(HepMC::GenEvent& evt) override;
+
+    int n_files() const;
+
+private:
+    std::string m_base{};
+    int m_events_per_file{-1};
+    int m_file_ievent{0};
+    int m_ifile{0};
+    std::unique_ptr<HepMC::IO_GenEvent> m_io{};
+};
+
+// Removes particles from the events before passing them on to `next`.
+// Both lists operate on the abs-value of the PID, `keep_ids` takes
+// precedence over `remove_ids` and, if not empty, all other particles are
+// removed.
+class PruneFilter : public EventSink {
+public:
+    PruneFilter(EventSink& next, std::vector<int> keep_ids,
+            std::vector<int> remove_ids);
+
+    void write(HepMC::GenEvent& evt) override;
+    void write(HepMC::GenEvent& evt,
+            const std::vector<std::string>& weight_names) override;
+
+private:
+    // Remove the particles selected by the id lists from `evt`.
+    void prune_event(HepMC::GenEvent& evt) const;
+
+    EventSink& m_next;
+    std::vector<int> m_keep_ids{};
+    std::vector<int> m_remove_ids{};
+};
+
+#endif /* EVENT_SINK_H_ */
@@ -0,0 +1,128 @@
+#ifndef EVENT_SOURCE_H_
+#define EVENT_SOURCE_H_
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HepMC/GenEvent.h"
+
+#include "event_reader.h"
+#include "pipe_stream.h"
+
+// Pull-based source of HepMC events.
+class EventSource {
+public:
+    virtual ~EventSource() = default;
+
+    // Read the next event into `evt`. Returns false once the source is
+    // exhausted.
+    virtual bool read(HepMC::GenEvent& evt) = 0;
+
+    // Read up to batch.size() events, returns the number of events read.
+    // The second form also stores the weight names of every event, to be
+    // passed on to EventSink::write_batch.
+    std::size_t read_batch(std::vector<HepMC::GenEvent>& batch);
+    std::size_t read_batch(std::vector<HepMC::GenEvent>& batch,
+            std::vector<std::vector<std::string>>& weight_names);
+
+    // Byte offset of the first event not read yet. Passing it to
+    // open_event_source continues reading from there.
+    virtual std::streamoff offset() const = 0;
+
+    // Names of the weights of the event read last, see also read_batch.
+    virtual const std::vector<std::string>& weight_names() const = 0;
+
+    // Print a summary of the input that had to be skipped.
+    virtual void report(std::ostream& os) const;
+
+    // Append source specific counters to a progress line.
+    virtual void progress(std::ostream& os) const;
+
+    // True if reading stopped because of an I/O error rather than at the
+    // end of the input.
+    virtual bool failed() const;
+};
+
+// HepMC2 ascii events, read through a Reader (see event_reader.h) so that
+// malformed events are skipped.
+class AsciiEventSource : public EventSource {
+public:
+    explicit AsciiEventSource(std::unique_ptr<std::istream> is,
+            std::streamoff offset = 0);
+
+    // Does not take ownership, e.g. for std::cin.
+    explicit AsciiEventSource(std::istream& is, std::streamoff offset = 0);
+
+    bool read(HepMC::GenEvent& evt) override;
+    std::streamoff offset() const override;
+    const std::vector<std::string>& weight_names() const override;
+    void report(std::ostream& os) const override;
+    bool failed() const override;
+
+protected:
+    std::unique_ptr<std::istream> m_owned{};
+    std::istream* m_is{nullptr};
+    Reader m_reader{};
+};
+
+// HepMC2 ascii file with the byte offset of every event, which gives random
+// access to the events, e.g. to hand out event ranges to several workers.
+// The stream must be seekable, see open_indexed_source.
+class IndexedEventSource : public AsciiEventSource {
+public:
+    explicit IndexedEventSource(std::unique_ptr<std::istream> is);
+
+    // Number of events in the file. Malformed events are counted as well,
+    // they are only detected (and skipped) when read.
+    std::size_t size() const;
+
+    // Continue reading at event `ievent`.
+    void seek(std::size_t ievent);
+
+private:
+    std::vector<std::streamoff> m_index{};
+    std::streamoff m_end{0};
+};
+
+// HepMC2 ascii events from stdin or a named pipe, e.g. written by a
+// generator that is still running. The pipe is drained ahead of the parser
+// by a background thread, see PipeStreambuf. report() includes how long
+// either side had to wait for the other.
+class PipeEventSource : public AsciiEventSource {
+public:
+    explicit PipeEventSource(std::unique_ptr<PipeIstream> is);
+
+    void report(std::ostream& os) const override;
+    void progress(std::ostream& os) const override;
+    bool failed() const override;
+
+private:
+    const PipeIstream* m_pipe{nullptr};
+};
+
+// True for stdin ("-") and named pipes, which can only be read once.
+bool is_pipe(const std::string& filename);
+
+// Open the uncompressed file `filename` with an index of its events.
+// Returns nullptr if the file cannot be opened.
+std::unique_ptr<IndexedEventSource> open_indexed_source(
+        const std::string& filename);
+
+// Open stdin ("-") or the named pipe `filename` with `n_buffers` read-ahead
+// buffers of `buffer_size` bytes. Returns nullptr if it cannot be opened.
+std::unique_ptr<EventSource> open_pipe_source(const std::string& filename,
+        std::size_t buffer_size = 1 << 20, std::size_t n_buffers = 16);
+
+// Open `filename` for reading, starting at byte `offset` of the uncompressed
+// input. Files ending in ".gz" are decompressed on the fly, stdin ("-") and
+// named pipes are read with open_pipe_source, using `n_buffers` buffers of
+// `buffer_size` bytes. Returns nullptr if the file cannot be opened, or if
+// an offset is given for a pipe.
+std::unique_ptr<EventSource> open_event_source(const std::string& filename,
+        std::streamoff offset = 0, std::size_t buffer_size = 1 << 20,
+        std::size_t n_buffers = 16);
+
+#endif /* EVENT_SOURCE_H_ */
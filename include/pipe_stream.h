@@ -0,0 +1,83 @@
+#ifndef PIPE_STREAM_H_
+#define PIPE_STREAM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+struct PipeStats {
+    // Bytes and read() calls done by the reader thread.
+    std::size_t bytes{0};
+    std::size_t reads{0};
+    // Largest number of filled buffers waiting to be parsed.
+    std::size_t max_filled{0};
+    // Number of times, and seconds in total, the reader thread had no free
+    // buffer and stopped draining the pipe: the writer is blocked while the
+    // parser catches up.
+    std::size_t stalls{0};
+    double stalled{0.};
+    // Number of times, and seconds in total, the parser waited for data
+    // from the writer.
+    std::size_t starves{0};
+    double starved{0.};
+    // errno of a failed poll() or read(), 0 if the pipe ended with an EOF.
+    int error{0};
+};
+
+// Reads a file descriptor, typically stdin or a named pipe, from a
+// background thread into `n_buffers` buffers of `buffer_size` bytes. The
+// parser works on one buffer while the others are being filled, and memory
+// use is bounded by n_buffers * buffer_size.
+class PipeStreambuf : public std::streambuf {
+public:
+    PipeStreambuf(int fd, bool owns_fd, std::size_t buffer_size,
+            std::size_t n_buffers);
+    ~PipeStreambuf() override;
+
+    PipeStats stats() const;
+
+    std::size_t buffer_size() const;
+    std::size_t n_buffers() const;
+
+protected:
+    int_type underflow() override;
+
+private:
+    void run();
+
+    int m_fd{-1};
+    bool m_owns_fd{false};
+
+    std::vector<std::vector<char>> m_buffers{};
+    std::vector<std::size_t> m_sizes{};
+    std::deque<std::size_t> m_free{};
+    std::deque<std::size_t> m_filled{};
+    std::size_t m_current{0};
+    bool m_has_current{false};
+    bool m_eof{false};
+
+    PipeStats m_stats{};
+    mutable std::mutex m_mutex{};
+    std::condition_variable m_cv{};
+    std::atomic<bool> m_stop{false};
+    std::thread m_thread{};
+};
+
+class PipeIstream : public std::istream {
+public:
+    PipeIstream(int fd, bool owns_fd, std::size_t buffer_size,
+            std::size_t n_buffers);
+
+    const PipeStreambuf& buf() const;
+
+private:
+    PipeStreambuf m_buf;
+};
+
+#endif /* PIPE_STREAM_H_ */
@@ -0,0 +1,59 @@
+#ifndef ROOT_TREE_SINK_H_
+#define ROOT_TREE_SINK_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "HepMC/GenEvent.h"
+
+#include "event.h"
+#include "event_sink.h"
+
+// Flattened events in the "nominal" tree of a ROOT file, see event.h.
+class RootTreeSink : public EventSink {
+public:
+    RootTreeSink(const std::string& filename, const RootTreeOptions& options);
+    ~RootTreeSink() override;
+
+    // Weights are named by their index.
+    void write(HepMC::GenEvent& evt) override;
+
+    // Names the weights after `weight_names`, e.g. EventSource::weight_names.
+    void write(HepMC::GenEvent& evt,
+            const std::vector<std::string>& weight_names) override;
+
+    // Print the number of events whose weights were truncated (see
+    // fill_weights in event.h), if any.
+    void report(std::ostream& os) const;
+
+    // See checkpoint() in event.h.
+    void checkpoint(std::streamoff input_offset);
+
+    // False if the output file could not be opened, the sink cannot be
+    // used then.
+    bool is_open() const;
+
+    // True if an existing tree is being continued.
+    bool resumed() const;
+
+    // Option that differs from the run that created the resumed tree, or
+    // an empty string. The sink cannot be written to if it is set.
+    const std::string& mismatch() const;
+
+    Long64_t entries() const;
+
+    // Input offset of the last checkpoint, or -1 if there is none.
+    std::streamoff last_checkpoint() const;
+
+    // Write the weight summary and the tree. A sink that is destroyed
+    // without being closed abandons everything after its last checkpoint.
+    void close();
+
+private:
+    RootTreeOptions m_options{};
+    Output m_output{};
+    bool m_resumed{false};
+};
+
+#endif /* ROOT_TREE_SINK_H_ */
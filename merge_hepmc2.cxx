@@ -1,11 +1,12 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <vector>
 
 #include <unistd.h>
 
 #include "HepMC/GenEvent.h"
-#include "HepMC/IO_GenEvent.h"
+
+#include "event_source.h"
+#include "event_sink.h"
 
 void usage(char** argv) {
     std::cout << "Merge several hepmc2-files into a single one.\n\n";
@@ -54,32 +55,34 @@ int main(int argc, char** argv) {
     }
     std::cout << "---> " << output << '\n';
 
-    auto* ascii_io = new HepMC::IO_GenEvent(output, std::ios::out);
+    AsciiEventSink sink(output);
+    std::vector<HepMC::GenEvent> batch(1000);
     int ievent = 0;
     for (auto& input : inputs) {
-        std::ifstream is(input);
-        HepMC::GenEvent evt;
+        auto source = open_event_source(input);
+        if (source == nullptr) {
+            std::cerr << "Could not open " << input << '\n';
+            return 1;
+        }
 
         std::cout << "<--- " << input << '\n';
 
         int file_ievent = 0;
-        while (is) {
+        while (true) {
 
-            if (ievent % 1000 == 0) {
-                std::cout << ievent << "   [ " << file_ievent << " ]" << '\n';
-            }
+            std::cout << ievent << "   [ " << file_ievent << " ]" << '\n';
 
-            evt.read(is);
-            if (evt.is_valid()) {
-                ascii_io->write_event(&evt);
-                ++ievent;
-                ++file_ievent;
+            auto n = source->read_batch(batch);
+            if (n == 0) {
+                break;
             }
+            sink.write_batch(batch, n);
+            ievent += n;
+            file_ievent += n;
         }
+        source->report(std::cout);
     }
     std::cout << "processed " << ievent << " events." << '\n';
 
-    delete ascii_io;
-
     return 0;
 }
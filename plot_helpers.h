@@ -1,7 +1,12 @@
 #ifndef PLOT_HELPERS_H_
 #define PLOT_HELPERS_H_
 
-int find_last_child(int p, const std::vector<std::vector<int>>& children,
+#include <vector>
+
+#include "TLorentzVector.h"
+
+inline int find_last_child(int p,
+        const std::vector<std::vector<int>>& children,
         const std::vector<int>& pdg_id) {
     int id = pdg_id[p];
     for (auto child : children[p]) {
@@ -13,7 +18,8 @@ int find_last_child(int p, const std::vector<std::vector<int>>& children,
     return p;
 }
 
-bool is_first_parent(int p, const std::vector<std::vector<int>>& parents,
+inline bool is_first_parent(int p,
+        const std::vector<std::vector<int>>& parents,
         const std::vector<int>& pdg_id) {
     auto id = pdg_id[p];
     for (auto parent : parents[p]) {
@@ -24,7 +30,70 @@ bool is_first_parent(int p, const std::vector<std::vector<int>>& parents,
     return true;
 }
 
-TLorentzVector to_v4(int p, const std::vector<double>& pt,
+// Evaluate find_last_child for every particle of an event in a single pass.
+// Chains that have already been followed are reused, so each particle is
+// visited once instead of once per query.
+inline std::vector<int> find_last_children(
+        const std::vector<std::vector<int>>& children,
+        const std::vector<int>& pdg_id) {
+    const int n = pdg_id.size();
+    std::vector<int> last(n, -1);
+    std::vector<int> chain;
+    for (int p = 0; p < n; ++p) {
+        chain.clear();
+        int q = p;
+        while (last[q] == -1) {
+            // -2 marks particles on the current chain, which also guards
+            // against malformed records that contain loops.
+            last[q] = -2;
+            chain.push_back(q);
+
+            int next = -1;
+            for (auto child : children[q]) {
+                if (pdg_id[q] == pdg_id[child]) {
+                    next = child;
+                    break;
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+            q = next;
+        }
+
+        const int end = last[q] >= 0 ? last[q] : q;
+        for (auto c : chain) {
+            last[c] = end;
+        }
+    }
+
+    return last;
+}
+
+// Evaluate is_first_parent for every particle of an event.
+inline std::vector<int> find_first_parents(
+        const std::vector<std::vector<int>>& parents,
+        const std::vector<int>& pdg_id) {
+    const int n = pdg_id.size();
+    std::vector<int> first(n);
+    for (int p = 0; p < n; ++p) {
+        first[p] = is_first_parent(p, parents, pdg_id);
+    }
+
+    return first;
+}
+
+// O(1) ancestry check using the tour_in/tour_out columns written by
+// `hepmc2root -t`. The intervals only cover the tree formed by the first
+// parent of every particle (like the root_ancestor column): a particle that
+// descends from `ancestor` only through a later parent, e.g. at a string
+// fragmentation vertex with several incoming partons, is not found.
+inline bool is_first_parent_descendant(int p, int ancestor,
+        const std::vector<int>& tour_in, const std::vector<int>& tour_out) {
+    return tour_in[ancestor] <= tour_in[p] && tour_in[p] <= tour_out[ancestor];
+}
+
+inline TLorentzVector to_v4(int p, const std::vector<double>& pt,
         const std::vector<double>& eta, const std::vector<double>& phi,
         const std::vector<double>& m) {
     TLorentzVector v;
@@ -1,14 +1,11 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
-#include <algorithm>
-#include <cassert>
 
 #include <unistd.h>
 
 #include "HepMC/GenEvent.h"
-#include "HepMC/GenRanges.h"
-#include "HepMC/IO_GenEvent.h"
+
+#include "event_source.h"
+#include "event_sink.h"
 
 void usage(char** argv) {
     std::cout << "Remove particles from hepmc2 files.\n\n";
@@ -86,84 +83,37 @@ int main(int argc, char** argv) {
     }
     std::cout << '\n';
 
-    auto contains = [](std::vector<int> list, int x) {
-        return std::find(list.begin(), list.end(), x) != list.end();
-    };
-
-    auto* ascii_io = new HepMC::IO_GenEvent(output, std::ios::out);
+    AsciiEventSink sink(output);
+    PruneFilter prune(sink, keep_ids, remove_ids);
     int ievent = 0;
     for (auto& input : inputs) {
-        std::ifstream is(input);
-        HepMC::GenEvent evt;
+        auto source = open_event_source(input);
+        if (source == nullptr) {
+            std::cerr << "Could not open " << input << '\n';
+            return 1;
+        }
 
         std::cout << "<--- " << input << '\n';
 
         int file_ievent = 0;
-        while (is) {
+        HepMC::GenEvent evt;
+        while (true) {
 
             if (ievent % 1000 == 0) {
                 std::cout << ievent << "   [ " << file_ievent << " ]" << '\n';
             }
 
-            std::vector<HepMC::GenParticle*> prune_particles = {};
-            std::vector<HepMC::GenVertex*> prune_vertices = {};
-
-            evt.read(is);
-            if (evt.is_valid()) {
-                for (auto p : evt.particle_range()) {
-                    int abs_id = std::abs(p->pdg_id());
-
-                    bool in_remove_list = contains(remove_ids, abs_id);
-                    bool in_keep_list = contains(keep_ids, abs_id);
-                    bool prune =
-                        (in_remove_list && !in_keep_list) ||
-                        (keep_ids.size() > 0 && !in_keep_list);
-
-                    if (prune) {
-                        prune_particles.push_back(p);
-                    }
-                }
-
-                while (prune_particles.size() > 0) {
-                    auto p = prune_particles.back();
-                    auto v_start = p->production_vertex();
-                    auto v_end = p->end_vertex();
-
-                    if (v_end != nullptr) {
-                        v_end->remove_particle(p);
-                    }
-
-                    if (v_start != nullptr) {
-                        v_start->remove_particle(p);
-                    }
-
-                    delete p;
-                    prune_particles.pop_back();
-                }
-
-                for (auto v : evt.vertex_range()) {
-                    auto n_in = v->particles_in_size();
-                    auto n_out = v->particles_out_size();
-                    bool prune = (n_in == 0) && (n_out == 0);
-                    if (prune) {
-                        prune_vertices.push_back(v);
-                    }
-                }
-
-                while (prune_vertices.size() > 0) {
-                    delete prune_vertices.back();
-                    prune_vertices.pop_back();
-                }
-
-                ascii_io->write_event(&evt);
-                ++ievent;
-                ++file_ievent;
+            if (!source->read(evt)) {
+                break;
             }
+
+            prune.write(evt);
+            ++ievent;
+            ++file_ievent;
         }
+        source->report(std::cout);
     }
     std::cout << "processed " << ievent << " events." << '\n';
 
-    delete ascii_io;
-
     return 0;
 }
@@ -1,11 +1,11 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 
 #include <unistd.h>
 
 #include "HepMC/GenEvent.h"
-#include "HepMC/IO_GenEvent.h"
+
+#include "event_source.h"
+#include "event_sink.h"
 
 void usage(char** argv) {
     std::cout << "Split a single hepmc2-file into several.\n\n";
@@ -52,46 +52,28 @@ int main(int argc, char** argv) {
     if (argc >= optind+2) {
         fn_output_base = argv[optind+1];
     }
-    std::stringstream fn_output;
 
-    std::ifstream is(fn_input);
+    auto source = open_event_source(fn_input);
+    if (source == nullptr) {
+        std::cerr << "Could not open " << fn_input << '\n';
+        return 1;
+    }
+
+    SplitEventSink sink(fn_output_base, events_per_file);
     HepMC::GenEvent evt;
     int ievent   = 0;
-    int file_ievent   = 0;
-    int ifile    = 0;
-
-    HepMC::IO_GenEvent* ascii_io = nullptr;
 
     std::cout << "Splitting input " << fn_input << " ...\n";
-    while (is) {
-        if (maxevents >= 0 && ievent >= maxevents) {
+    while (maxevents < 0 || ievent < maxevents) {
+        if (!source->read(evt)) {
             break;
         }
 
-        if (events_per_file > 0 && file_ievent >= events_per_file) {
-            file_ievent = 0;
-            if (ascii_io != nullptr) {
-                delete ascii_io;
-                ascii_io = nullptr;
-            }
-        }
-
-        evt.read(is);
-
-        if (evt.is_valid()) {
-            if (ascii_io == nullptr) {
-                std::stringstream().swap(fn_output);
-                fn_output << fn_output_base << "." << ifile++;
-                ascii_io = new HepMC::IO_GenEvent(fn_output.str(), std::ios::out);
-            }
-            ascii_io->write_event(&evt);
-            ++ievent;
-            ++file_ievent;
-        }
+        sink.write(evt);
+        ++ievent;
     }
-    std::cout << ievent << " events split over " << ifile << " files." << '\n';
-
-    delete ascii_io;
+    std::cout << ievent << " events split over " << sink.n_files() << " files." << '\n';
+    source->report(std::cout);
 
     return 0;
 }
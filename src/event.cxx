@@ -0,0 +1,620 @@
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include "HepMC/GenRanges.h"
+
+#include "TLeaf.h"
+#include "TList.h"
+#include "TParameter.h"
+
+#include "event.h"
+
+namespace {
+
+template<typename T, typename F>
+auto find_idx(const T& v, F&& pred) {
+    const auto& pos = std::find_if(std::begin(v), std::end(v), pred);
+    return std::distance(std::begin(v), pos);
+}
+
+auto fill_particle(const HepMC::GenParticle& p, Event& event) {
+    event.pdg_id.push_back(p.pdg_id());
+    event.barcode.push_back(p.barcode());
+    event.status.push_back(p.status());
+    event.is_final_state.push_back((int)(p.status() == 1));
+
+    const auto& momentum = p.momentum();
+    event.pt.push_back(momentum.perp());
+    event.e.push_back(momentum.e());
+    event.m.push_back(momentum.m());
+    event.eta.push_back(momentum.eta());
+    event.phi.push_back(momentum.phi());
+
+    return event.pdg_id.size() - 1;
+}
+
+void fill_vertex(int i, const HepMC::GenVertex& v, Event& event) {
+    event.vtx_barcode[i] = v.barcode();
+
+    const auto& position = v.position();
+    event.vtx_x[i]       = position.x();
+    event.vtx_y[i]       = position.y();
+    event.vtx_z[i]       = position.z();
+    event.vtx_t[i]       = position.t();
+}
+
+template<typename T>
+void set_parameter(TList& list, const char* name, T value) {
+    auto* parameter = static_cast<TParameter<T>*>(list.FindObject(name));
+    if (parameter == nullptr) {
+        list.Add(new TParameter<T>(name, value));
+    } else {
+        parameter->SetVal(value);
+    }
+}
+
+template<typename T>
+T get_parameter(const TList& list, const char* name, T fallback) {
+    auto* parameter = static_cast<TParameter<T>*>(list.FindObject(name));
+    return parameter != nullptr ? parameter->GetVal() : fallback;
+}
+
+// The weight summary is kept in the tree's user info, next to input_offset,
+// so that a checkpoint commits it in the same write as the entries it
+// covers: a "weight_summary" list with one list per weight, named after the
+// weight and holding its sum_w, sum_w2 and n.
+void store_weight_summary(Output& output) {
+    auto* info = output.tree->GetUserInfo();
+    delete info->Remove(info->FindObject("weight_summary"));
+
+    const auto& summary = output.weights;
+    auto* list = new TList();
+    list->SetName("weight_summary");
+    list->SetOwner(true);
+    for (size_t i = 0; i < summary.names.size(); ++i) {
+        auto* weight = new TList();
+        weight->SetName(summary.names[i].c_str());
+        weight->SetOwner(true);
+        weight->Add(new TParameter<double>("sum_w", summary.sum_w[i]));
+        weight->Add(new TParameter<double>("sum_w2", summary.sum_w2[i]));
+        weight->Add(new TParameter<Long64_t>("n", summary.n[i]));
+        list->Add(weight);
+    }
+    info->Add(list);
+
+    set_parameter<Long64_t>(*info, "truncated_weights",
+            output.truncated_weights);
+}
+
+void read_weight_summary(Output& output) {
+    auto* info = output.tree->GetUserInfo();
+    output.truncated_weights =
+        get_parameter<Long64_t>(*info, "truncated_weights", 0);
+
+    auto* list = static_cast<TList*>(info->FindObject("weight_summary"));
+    if (list == nullptr) {
+        return;
+    }
+    list->SetOwner(true);
+
+    auto& summary = output.weights;
+    TIter next(list);
+    while (auto* weight = static_cast<TList*>(next())) {
+        weight->SetOwner(true);
+        summary.names.push_back(weight->GetName());
+        summary.sum_w.push_back(get_parameter<double>(*weight, "sum_w", 0.));
+        summary.sum_w2.push_back(get_parameter<double>(*weight, "sum_w2", 0.));
+        summary.n.push_back(get_parameter<Long64_t>(*weight, "n", 0));
+    }
+}
+
+// The options that determine the layout of the tree, as stored in its user
+// info.
+std::vector<std::pair<const char*, bool>> layout_options(
+        const RootTreeOptions& options) {
+    return {
+        {"flat",          options.flat},
+        {"euler_tour",    options.euler_tour},
+        {"float_weights", options.float_weights},
+    };
+}
+
+std::string layout_mismatch(TTree& tree, const RootTreeOptions& options) {
+    auto* info = tree.GetUserInfo();
+    for (const auto& option : layout_options(options)) {
+        auto* stored = static_cast<TParameter<int>*>(
+                info->FindObject(option.first));
+        if (stored == nullptr || (stored->GetVal() != 0) != option.second) {
+            return option.first;
+        }
+    }
+    return "";
+}
+
+} // namespace
+
+void clear(Event& event) {
+    event.number      = 0;
+    event.n_particles = 0;
+    event.n_vertices  = 0;
+    event.mpi         = 0;
+    event.scale       = 0.;
+    event.alphaQCD    = 0.;
+    event.alphaQED    = 0.;
+    event.id1         = 0;
+    event.id2         = 0;
+    event.pdf_id1     = 0;
+    event.pdf_id2     = 0;
+    event.x1          = 0.;
+    event.x2          = 0.;
+    event.scalePDF    = 0.;
+    event.pdf1        = 0.;
+    event.pdf2        = 0.;
+
+    event.weights.clear();
+    event.pdg_id.clear();
+    event.barcode.clear();
+    event.status.clear();
+    event.is_final_state.clear();
+    event.prod_vtx.clear();
+    event.decay_vtx.clear();
+    event.prod_vtx_barcode.clear();
+    event.decay_vtx_barcode.clear();
+
+    event.children.clear();
+    event.parents.clear();
+
+    event.last_copy.clear();
+    event.first_copy.clear();
+    event.root_ancestor.clear();
+    event.depth.clear();
+    event.tour_in.clear();
+    event.tour_out.clear();
+
+    event.pt.clear();
+    event.e.clear();
+    event.m.clear();
+    event.eta.clear();
+    event.phi.clear();
+
+    event.vtx_barcode.clear();
+
+    event.vtx_x.clear();
+    event.vtx_y.clear();
+    event.vtx_z.clear();
+    event.vtx_t.clear();
+
+    event.vtx_part_in.clear();
+    event.vtx_part_out.clear();
+    event.vtx_part_in_barcode.clear();
+    event.vtx_part_out_barcode.clear();
+}
+
+bool make_output(const std::string& fn_output, Output& output,
+        const RootTreeOptions& options) {
+    const auto flat       = options.flat;
+    const auto euler_tour = options.euler_tour;
+
+    output.mismatch.clear();
+    output.file = std::unique_ptr<TFile>(TFile::Open(
+            fn_output.c_str(), options.resume ? "UPDATE" : "RECREATE"));
+    if (output.file == nullptr) {
+        return false;
+    }
+    output.file->cd();
+
+    TTree* tree = nullptr;
+    if (options.resume) {
+        output.file->GetObject("nominal", tree);
+    }
+    const bool existing = tree != nullptr;
+    if (existing) {
+        output.tree = std::unique_ptr<TTree>(tree);
+        output.mismatch = layout_mismatch(*output.tree, options);
+        if (!output.mismatch.empty()) {
+            return existing;
+        }
+    } else {
+        output.tree = std::make_unique<TTree>("nominal", "nominal");
+        auto* info = output.tree->GetUserInfo();
+        for (const auto& option : layout_options(options)) {
+            info->Add(new TParameter<int>(option.first, option.second));
+        }
+    }
+
+    auto branch = [&output, existing](const char* name, auto* address) {
+        if (existing) {
+            output.tree->SetBranchAddress(name, address);
+        } else {
+            output.tree->Branch(name, address);
+        }
+    };
+
+    branch("event_number", &output.event.number);
+    branch("n_particles",  &output.event.n_particles);
+    branch("n_vertices",   &output.event.n_vertices);
+    branch("mpi",          &output.event.mpi);
+    branch("scale",        &output.event.scale);
+    branch("alphaQCD",     &output.event.alphaQCD);
+    branch("alphaQED",     &output.event.alphaQED);
+    branch("id1",          &output.event.id1);
+    branch("id2",          &output.event.id2);
+    branch("pdf_id1",      &output.event.pdf_id1);
+    branch("pdf_id2",      &output.event.pdf_id2);
+    branch("x1",           &output.event.x1);
+    branch("x2",           &output.event.x2);
+    branch("scalePDF",     &output.event.scalePDF);
+    branch("pdf1",         &output.event.pdf1);
+    branch("pdf2",         &output.event.pdf2);
+
+    // The fixed-width weights are booked by fill_weights, once their
+    // number is known.
+    if (!options.float_weights) {
+        branch("weights", &output.event.weights);
+    }
+
+    branch("pdg_id",            &output.event.pdg_id);
+    branch("barcode",           &output.event.barcode);
+    branch("status",            &output.event.status);
+    branch("is_final_state",    &output.event.is_final_state);
+
+    if (!flat) {
+        branch("prod_vtx",          &output.event.prod_vtx);
+        branch("decay_vtx",         &output.event.decay_vtx);
+        branch("prod_vtx_barcode",  &output.event.prod_vtx_barcode);
+        branch("decay_vtx_barcode", &output.event.decay_vtx_barcode);
+        branch("children",          &output.event.children);
+        branch("parents",           &output.event.parents);
+
+        branch("last_copy",     &output.event.last_copy);
+        branch("first_copy",    &output.event.first_copy);
+        branch("root_ancestor", &output.event.root_ancestor);
+        branch("depth",         &output.event.depth);
+
+        if (euler_tour) {
+            branch("tour_in",  &output.event.tour_in);
+            branch("tour_out", &output.event.tour_out);
+        }
+    }
+
+    branch("pt",  &output.event.pt);
+    branch("e",   &output.event.e);
+    branch("m",   &output.event.m);
+    branch("eta", &output.event.eta);
+    branch("phi", &output.event.phi);
+
+    if (!flat) {
+        branch("vtx_barcode", &output.event.vtx_barcode);
+        branch("vtx_x",       &output.event.vtx_x);
+        branch("vtx_y",       &output.event.vtx_y);
+        branch("vtx_z",       &output.event.vtx_z);
+        branch("vtx_t",       &output.event.vtx_t);
+
+        branch("vtx_part_in_barcode",  &output.event.vtx_part_in_barcode);
+        branch("vtx_part_out_barcode", &output.event.vtx_part_out_barcode);
+        branch("vtx_part_in",          &output.event.vtx_part_in);
+        branch("vtx_part_out",         &output.event.vtx_part_out);
+    }
+
+    if (existing) {
+        read_weight_summary(output);
+    }
+
+    return existing;
+}
+
+void checkpoint(Output& output, Long64_t input_offset) {
+    set_parameter<Long64_t>(*output.tree->GetUserInfo(), "input_offset",
+            input_offset);
+    store_weight_summary(output);
+    output.tree->AutoSave("SaveSelf");
+}
+
+Long64_t last_checkpoint(const Output& output) {
+    return get_parameter<Long64_t>(*output.tree->GetUserInfo(),
+            "input_offset", -1);
+}
+
+void fill_weights(const HepMC::GenEvent& evt,
+        const std::vector<std::string>& names, Output& output, bool fixed) {
+    const auto& weights = evt.weights();
+    auto& event   = output.event;
+    auto& summary = output.weights;
+
+    if (summary.names.size() < weights.size()) {
+        for (auto i = summary.names.size(); i < weights.size(); ++i) {
+            summary.names.push_back(
+                    i < names.size() ? names[i] : std::to_string(i));
+        }
+        summary.sum_w.resize(weights.size(), 0.);
+        summary.sum_w2.resize(weights.size(), 0.);
+        summary.n.resize(weights.size(), 0);
+    }
+
+    for (size_t i = 0; i < weights.size(); ++i) {
+        const double w = weights[i];
+        summary.sum_w[i]  += w;
+        summary.sum_w2[i] += w * w;
+        ++summary.n[i];
+    }
+
+    if (!fixed) {
+        event.weights.assign(weights.begin(), weights.end());
+        return;
+    }
+
+    // The branch reads straight from weight_values, so it must not be
+    // resized once booked.
+    if (event.weight_values.empty()) {
+        auto* leaf = output.tree->GetLeaf("weights");
+        if (leaf != nullptr) {
+            event.weight_values.resize(leaf->GetLenStatic());
+            output.tree->SetBranchAddress(
+                    "weights", event.weight_values.data());
+        } else {
+            event.weight_values.resize(std::max<size_t>(weights.size(), 1));
+            const auto leaflist = "weights[" +
+                    std::to_string(event.weight_values.size()) + "]/F";
+            output.tree->Branch(
+                    "weights", event.weight_values.data(), leaflist.c_str());
+        }
+    }
+
+    if (weights.size() > event.weight_values.size()) {
+        ++output.truncated_weights;
+    }
+    const auto n = std::min(weights.size(), event.weight_values.size());
+    for (size_t i = 0; i < n; ++i) {
+        event.weight_values[i] = weights[i];
+    }
+    std::fill(event.weight_values.begin() + n, event.weight_values.end(), 0.f);
+}
+
+void write_weight_summary(Output& output) {
+    output.file->cd();
+
+    auto tree = std::make_unique<TTree>("weight_summary", "weight_summary");
+    std::string name;
+    double sum_w  = 0.;
+    double sum_w2 = 0.;
+    Long64_t n    = 0;
+    tree->Branch("name",   &name);
+    tree->Branch("sum_w",  &sum_w);
+    tree->Branch("sum_w2", &sum_w2);
+    tree->Branch("n",      &n);
+
+    const auto& summary = output.weights;
+    for (size_t i = 0; i < summary.names.size(); ++i) {
+        name   = summary.names[i];
+        sum_w  = summary.sum_w[i];
+        sum_w2 = summary.sum_w2[i];
+        n      = summary.n[i];
+        tree->Fill();
+    }
+    tree->Write("", TObject::kOverwrite);
+}
+
+void fill_ancestry(Event& event, bool euler_tour) {
+    const int n = event.pdg_id.size();
+    const auto& children = event.children;
+    const auto& parents  = event.parents;
+
+    event.last_copy.resize(n);
+    event.first_copy.resize(n);
+    event.root_ancestor.resize(n);
+    event.depth.assign(n, 0);
+    for (int p = 0; p < n; ++p) {
+        event.last_copy[p]     = p;
+        event.first_copy[p]    = p;
+        event.root_ancestor[p] = p;
+    }
+
+    std::vector<int> order;
+    std::vector<int> n_parents(n);
+    order.reserve(n);
+    for (int p = 0; p < n; ++p) {
+        n_parents[p] = parents[p].size();
+        if (n_parents[p] == 0) {
+            order.push_back(p);
+        }
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (auto child : children[order[i]]) {
+            if (--n_parents[child] == 0) {
+                order.push_back(child);
+            }
+        }
+    }
+    // Malformed records can contain loops that are never reached. Append
+    // them so that every particle still gets a (self-referencing) entry.
+    if (order.size() < (unsigned)n) {
+        for (int p = 0; p < n; ++p) {
+            if (n_parents[p] > 0) {
+                order.push_back(p);
+            }
+        }
+    }
+
+    for (auto p : order) {
+        if (parents[p].empty()) {
+            continue;
+        }
+
+        const auto q = parents[p].front();
+        event.root_ancestor[p] = event.root_ancestor[q];
+        event.depth[p]         = event.depth[q] + 1;
+
+        for (auto parent : parents[p]) {
+            if (event.pdg_id[p] == event.pdg_id[parent]) {
+                event.first_copy[p] = event.first_copy[parent];
+                break;
+            }
+        }
+    }
+
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const auto p = *it;
+        for (auto child : children[p]) {
+            if (event.pdg_id[p] == event.pdg_id[child]) {
+                event.last_copy[p] = event.last_copy[child];
+                break;
+            }
+        }
+    }
+
+    if (!euler_tour) {
+        return;
+    }
+
+    event.tour_in.assign(n, -1);
+    event.tour_out.assign(n, -1);
+
+    int timer = 0;
+    std::vector<std::pair<int, size_t>> stack;
+    auto visit = [&](int r) {
+        event.tour_in[r] = timer++;
+        stack.emplace_back(r, 0);
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            const auto p = top.first;
+            if (top.second < children[p].size()) {
+                const auto child = children[p][top.second++];
+                if (event.tour_in[child] == -1 &&
+                        parents[child].front() == p) {
+                    event.tour_in[child] = timer++;
+                    stack.emplace_back(child, 0);
+                }
+            } else {
+                event.tour_out[p] = timer - 1;
+                stack.pop_back();
+            }
+        }
+    };
+
+    for (auto p : order) {
+        if (event.tour_in[p] == -1) {
+            visit(p);
+        }
+    }
+}
+
+int process_evt(const HepMC::GenEvent& evt, Event& event, bool flat,
+        bool euler_tour) {
+
+    event.number      = evt.event_number();
+    event.n_particles = evt.particles_size();
+    event.n_vertices  = evt.vertices_size();
+    event.mpi         = evt.mpi();
+    event.scale       = evt.event_scale();
+    event.alphaQCD    = evt.alphaQCD();
+    event.alphaQED    = evt.alphaQED();
+
+    const auto& pdf_info = evt.pdf_info();
+    if (pdf_info != nullptr) {
+        event.id1      = pdf_info->id1();
+        event.id2      = pdf_info->id2();
+        event.pdf_id1  = pdf_info->pdf_id1();
+        event.pdf_id2  = pdf_info->pdf_id2();
+        event.x1       = pdf_info->x1();
+        event.x2       = pdf_info->x2();
+        event.scalePDF = pdf_info->scalePDF();
+        event.pdf1     = pdf_info->pdf1();
+        event.pdf2     = pdf_info->pdf2();
+    }
+
+    const auto& particles = evt.particle_range();
+    const auto& vertices  = evt.vertex_range();
+
+    auto n_particles =
+            std::distance(std::begin(particles), std::end(particles));
+    auto n_vertices = std::distance(std::begin(vertices), std::end(vertices));
+
+    assert(n_particles >= 0);
+    assert(n_vertices >= 0);
+
+    event.children.resize(n_particles);
+    event.parents.resize(n_particles);
+    event.prod_vtx.resize(n_particles);
+    event.decay_vtx.resize(n_particles);
+    event.prod_vtx_barcode.resize(n_particles);
+    event.decay_vtx_barcode.resize(n_particles);
+
+    event.vtx_barcode.resize(n_vertices);
+    event.vtx_x.resize(n_vertices);
+    event.vtx_y.resize(n_vertices);
+    event.vtx_z.resize(n_vertices);
+    event.vtx_t.resize(n_vertices);
+    event.vtx_part_in_barcode.resize(n_vertices);
+    event.vtx_part_out_barcode.resize(n_vertices);
+    event.vtx_part_in.resize(n_vertices);
+    event.vtx_part_out.resize(n_vertices);
+
+    for (const auto& p : particles) {
+        auto ip = fill_particle(*p, event);
+        assert(ip < (unsigned)n_particles);
+
+        const auto& prod_vtx = p->production_vertex();
+        if (prod_vtx != nullptr && !flat) {
+            event.prod_vtx_barcode[ip] = prod_vtx->barcode();
+
+            auto iv = find_idx(vertices, [&prod_vtx](const auto& v) {
+                    return prod_vtx->barcode() == v->barcode();
+                    });
+            assert(iv >= 0);
+            assert(iv < n_vertices);
+
+            fill_vertex(iv, *prod_vtx, event);
+
+            event.prod_vtx[ip] = iv;
+            event.vtx_part_out_barcode[iv].push_back(p->barcode());
+            event.vtx_part_out[iv].push_back(ip);
+        } else {
+            event.prod_vtx[ip] = -1;
+        }
+
+        const auto& end_vtx = p->end_vertex();
+        if (end_vtx != nullptr && !flat) {
+            event.decay_vtx_barcode[ip] = end_vtx->barcode();
+
+            auto iv = find_idx(vertices, [&end_vtx](const auto& v) {
+                    return end_vtx->barcode() == v->barcode();
+                    });
+            assert(iv >= 0);
+            assert(iv < n_vertices);
+
+            fill_vertex(iv, *end_vtx, event);
+
+            event.decay_vtx[ip] = iv;
+            event.vtx_part_in_barcode[iv].push_back(p->barcode());
+            event.vtx_part_in[iv].push_back(ip);
+        } else {
+            event.decay_vtx[ip] = -1;
+        }
+    }
+
+    if (!flat) {
+        for (size_t ip = 0; ip < (unsigned)n_particles; ++ip) {
+            const auto iv_prod  = event.prod_vtx[ip];
+            const auto iv_decay = event.decay_vtx[ip];
+
+            if (iv_decay > -1) {
+                for (const auto& child : event.vtx_part_out[iv_decay]) {
+                    event.children[ip].push_back(child);
+                }
+            }
+
+            if (iv_prod > -1) {
+                for (const auto& parent : event.vtx_part_in[iv_prod]) {
+                    event.parents[ip].push_back(parent);
+                }
+            }
+        }
+
+        fill_ancestry(event, euler_tour);
+    }
+
+    return 0;
+}
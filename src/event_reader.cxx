@@ -0,0 +1,165 @@
+#include <algorithm>
+
+#include "event_reader.h"
+
+namespace {
+
+bool is_event_line(const std::string& line) {
+    return line.compare(0, 2, "E ") == 0;
+}
+
+bool is_io_line(const std::string& line) {
+    return line.compare(0, 7, "HepMC::") == 0;
+}
+
+bool next_line(Reader& reader) {
+    if (!std::getline(*reader.is, reader.line)) {
+        return false;
+    }
+    reader.line_offset = reader.offset;
+    reader.offset += reader.line.size() + 1;
+    return true;
+}
+
+// Weight names from the `N` line of an event, e.g. N 2 "nominal" "muR=2".
+void parse_weight_names(const std::string& text, std::size_t n_weights,
+        std::vector<std::string>& names) {
+    names.clear();
+
+    auto pos = text.find("\nN ");
+    if (pos != std::string::npos) {
+        ++pos;
+        const auto eol = std::min(text.find('\n', pos), text.size());
+        while (true) {
+            const auto open = text.find('"', pos);
+            if (open >= eol) {
+                break;
+            }
+            const auto close = text.find('"', open + 1);
+            if (close >= eol) {
+                break;
+            }
+            names.push_back(text.substr(open + 1, close - open - 1));
+            pos = close + 1;
+        }
+    }
+
+    for (auto i = names.size(); i < n_weights; ++i) {
+        names.push_back(std::to_string(i));
+    }
+}
+
+void skip(Reader& reader, std::streamoff begin, std::streamoff end) {
+    if (!reader.skipped.empty() && reader.skipped.back().second == begin) {
+        reader.skipped.back().second = end;
+    } else {
+        reader.skipped.emplace_back(begin, end);
+    }
+}
+
+} // namespace
+
+void open_reader(std::istream& is, Reader& reader, std::streamoff offset) {
+    reader.is = &is;
+
+    bool found_start = false;
+    while (!found_start && next_line(reader)) {
+        if (is_event_line(reader.line)) {
+            reader.has_line = true;
+            break;
+        }
+        reader.header += reader.line;
+        reader.header += '\n';
+        found_start = reader.line.find("START_EVENT_LISTING") !=
+                      std::string::npos;
+    }
+    if (!found_start) {
+        reader.header += "HepMC::IO_GenEvent-START_EVENT_LISTING\n";
+    }
+
+    if (offset > 0) {
+        is.clear();
+        is.seekg(offset);
+        reader.offset   = offset;
+        reader.has_line = false;
+    }
+}
+
+bool read_event(Reader& reader, HepMC::GenEvent& evt) {
+    while (true) {
+        if (!reader.has_line && !next_line(reader)) {
+            return false;
+        }
+        reader.has_line = false;
+
+        if (!is_event_line(reader.line)) {
+            // Blank lines and the markers of concatenated files are fine,
+            // anything else between events is left over from a broken one.
+            if (!reader.line.empty() && !is_io_line(reader.line)) {
+                skip(reader, reader.line_offset, reader.offset);
+            }
+            continue;
+        }
+
+        const auto begin = reader.line_offset;
+        reader.text.clear();
+        reader.text += reader.line;
+        reader.text += '\n';
+        while (next_line(reader)) {
+            if (is_event_line(reader.line) || is_io_line(reader.line)) {
+                reader.has_line = true;
+                break;
+            }
+            reader.text += reader.line;
+            reader.text += '\n';
+        }
+        const auto end = reader.has_line ? reader.line_offset : reader.offset;
+
+        // HepMC needs to see the header once per stream before the first
+        // event, the buffer is reset after a failure so it is reparsed.
+        if (reader.first) {
+            reader.buffer.str(reader.header + reader.text);
+        } else {
+            reader.buffer.str(reader.text);
+        }
+        reader.buffer.clear();
+
+        try {
+            evt.read(reader.buffer);
+        } catch (...) {
+            reader.buffer.setstate(std::ios::badbit);
+        }
+
+        if (reader.buffer.bad() || !evt.is_valid()) {
+            skip(reader, begin, end);
+            std::stringstream().swap(reader.buffer);
+            reader.first = true;
+            continue;
+        }
+
+        parse_weight_names(reader.text, evt.weights().size(),
+                reader.weight_names);
+        reader.first = false;
+        return true;
+    }
+}
+
+std::streamoff resume_offset(const Reader& reader) {
+    return reader.has_line ? reader.line_offset : reader.offset;
+}
+
+void report(const Reader& reader, std::ostream& os) {
+    if (reader.skipped.empty()) {
+        return;
+    }
+
+    std::streamoff bytes = 0;
+    for (const auto& range : reader.skipped) {
+        bytes += range.second - range.first;
+    }
+    os << "Skipped " << reader.skipped.size() << " malformed byte range(s), "
+       << bytes << " bytes in total:\n";
+    for (const auto& range : reader.skipped) {
+        os << "  [" << range.first << ", " << range.second << ")\n";
+    }
+}
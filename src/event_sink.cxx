@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include "HepMC/GenRanges.h"
+
+#include "event_sink.h"
+
+void EventSink::write(HepMC::GenEvent& evt,
+        const std::vector<std::string>&) {
+    write(evt);
+}
+
+void EventSink::write_batch(std::vector<HepMC::GenEvent>& batch,
+        std::size_t n) {
+    for (std::size_t i = 0; i < n && i < batch.size(); ++i) {
+        write(batch[i]);
+    }
+}
+
+void EventSink::write_batch(std::vector<HepMC::GenEvent>& batch,
+        std::size_t n,
+        const std::vector<std::vector<std::string>>& weight_names) {
+    for (std::size_t i = 0; i < n && i < batch.size(); ++i) {
+        if (i < weight_names.size()) {
+            write(batch[i], weight_names[i]);
+        } else {
+            write(batch[i]);
+        }
+    }
+}
+
+AsciiEventSink::AsciiEventSink(const std::string& filename)
+    : m_io(std::make_unique<HepMC::IO_GenEvent>(filename, std::ios::out)) {
+}
+
+AsciiEventSink::AsciiEventSink(std::ostream& os)
+    : m_io(std::make_unique<HepMC::IO_GenEvent>(os)) {
+}
+
+void AsciiEventSink::write(HepMC::GenEvent& evt) {
+    m_io->write_event(&evt);
+}
+
+SplitEventSink::SplitEventSink(const std::string& base, int events_per_file)
+    : m_base(base), m_events_per_file(events_per_file) {
+}
+
+void SplitEventSink::write(HepMC::GenEvent& evt) {
+    if (m_events_per_file > 0 && m_file_ievent >= m_events_per_file) {
+        m_file_ievent = 0;
+        m_io.reset();
+    }
+
+    if (m_io == nullptr) {
+        std::stringstream fn_output;
+        fn_output << m_base << "." << m_ifile++;
+        m_io = std::make_unique<HepMC::IO_GenEvent>(
+                fn_output.str(), std::ios::out);
+    }
+    m_io->write_event(&evt);
+    ++m_file_ievent;
+}
+
+int SplitEventSink::n_files() const {
+    return m_ifile;
+}
+
+PruneFilter::PruneFilter(EventSink& next, std::vector<int> keep_ids,
+        std::vector<int> remove_ids)
+    : m_next(next), m_keep_ids(std::move(keep_ids)),
+      m_remove_ids(std::move(remove_ids)) {
+}
+
+void PruneFilter::write(HepMC::GenEvent& evt) {
+    prune_event(evt);
+    m_next.write(evt);
+}
+
+void PruneFilter::write(HepMC::GenEvent& evt,
+        const std::vector<std::string>& weight_names) {
+    prune_event(evt);
+    m_next.write(evt, weight_names);
+}
+
+void PruneFilter::prune_event(HepMC::GenEvent& evt) const {
+    auto contains = [](const std::vector<int>& list, int x) {
+        return std::find(list.begin(), list.end(), x) != list.end();
+    };
+
+    std::vector<HepMC::GenParticle*> prune_particles = {};
+    std::vector<HepMC::GenVertex*> prune_vertices = {};
+
+    for (auto p : evt.particle_range()) {
+        int abs_id = std::abs(p->pdg_id());
+
+        bool in_remove_list = contains(m_remove_ids, abs_id);
+        bool in_keep_list = contains(m_keep_ids, abs_id);
+        bool prune =
+            (in_remove_list && !in_keep_list) ||
+            (m_keep_ids.size() > 0 && !in_keep_list);
+
+        if (prune) {
+            prune_particles.push_back(p);
+        }
+    }
+
+    while (prune_particles.size() > 0) {
+        auto p = prune_particles.back();
+        auto v_start = p->production_vertex();
+        auto v_end = p->end_vertex();
+
+        if (v_end != nullptr) {
+            v_end->remove_particle(p);
+        }
+
+        if (v_start != nullptr) {
+            v_start->remove_particle(p);
+        }
+
+        delete p;
+        prune_particles.pop_back();
+    }
+
+    for (auto v : evt.vertex_range()) {
+        auto n_in = v->particles_in_size();
+        auto n_out = v->particles_out_size();
+        bool prune = (n_in == 0) && (n_out == 0);
+        if (prune) {
+            prune_vertices.push_back(v);
+        }
+    }
+
+    while (prune_vertices.size() > 0) {
+        delete prune_vertices.back();
+        prune_vertices.pop_back();
+    }
+}
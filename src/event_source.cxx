@@ -0,0 +1,272 @@
+#include <cstring>
+#include <fstream>
+#include <streambuf>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "event_source.h"
+
+namespace {
+
+// Decompresses a gzip file while it is being read. Positions refer to the
+// uncompressed data.
+class GzipStreambuf : public std::streambuf {
+public:
+    explicit GzipStreambuf(const std::string& filename)
+        : m_file(gzopen(filename.c_str(), "rb")) {
+        if (m_file != nullptr) {
+            gzbuffer(m_file, m_buffer.size());
+        }
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+    }
+
+    ~GzipStreambuf() override {
+        if (m_file != nullptr) {
+            gzclose(m_file);
+        }
+    }
+
+    bool is_open() const {
+        return m_file != nullptr;
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+
+        m_start += egptr() - eback();
+        int n = gzread(m_file, m_buffer.data(), m_buffer.size());
+        if (n <= 0) {
+            return traits_type::eof();
+        }
+
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+            std::ios_base::openmode mode) override {
+        if (dir == std::ios_base::beg) {
+            return seekpos(off, mode);
+        }
+        if (dir == std::ios_base::cur) {
+            return seekpos(m_start + (gptr() - eback()) + off, mode);
+        }
+        return pos_type(off_type(-1));
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode) override {
+        if (gzseek(m_file, pos, SEEK_SET) < 0) {
+            return pos_type(off_type(-1));
+        }
+        m_start = pos;
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+        return pos;
+    }
+
+private:
+    gzFile m_file{nullptr};
+    std::vector<char> m_buffer = std::vector<char>(1 << 17);
+    std::streamoff m_start{0};
+};
+
+class GzipIstream : public std::istream {
+public:
+    explicit GzipIstream(const std::string& filename)
+        : std::istream(nullptr), m_buf(filename) {
+        rdbuf(&m_buf);
+        if (!m_buf.is_open()) {
+            setstate(std::ios::failbit);
+        }
+    }
+
+private:
+    GzipStreambuf m_buf;
+};
+
+bool ends_with(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() &&
+           s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+bool is_pipe(const std::string& filename) {
+    struct stat st;
+    return filename == "-" ||
+           (stat(filename.c_str(), &st) == 0 && S_ISFIFO(st.st_mode));
+}
+
+std::size_t EventSource::read_batch(std::vector<HepMC::GenEvent>& batch) {
+    std::size_t n = 0;
+    while (n < batch.size() && read(batch[n])) {
+        ++n;
+    }
+    return n;
+}
+
+std::size_t EventSource::read_batch(std::vector<HepMC::GenEvent>& batch,
+        std::vector<std::vector<std::string>>& weight_names) {
+    weight_names.resize(batch.size());
+    std::size_t n = 0;
+    while (n < batch.size() && read(batch[n])) {
+        weight_names[n] = this->weight_names();
+        ++n;
+    }
+    return n;
+}
+
+void EventSource::report(std::ostream&) const {
+}
+
+void EventSource::progress(std::ostream&) const {
+}
+
+bool EventSource::failed() const {
+    return false;
+}
+
+AsciiEventSource::AsciiEventSource(std::unique_ptr<std::istream> is,
+        std::streamoff offset)
+    : m_owned(std::move(is)), m_is(m_owned.get()) {
+    open_reader(*m_is, m_reader, offset);
+}
+
+AsciiEventSource::AsciiEventSource(std::istream& is, std::streamoff offset)
+    : m_is(&is) {
+    open_reader(*m_is, m_reader, offset);
+}
+
+bool AsciiEventSource::read(HepMC::GenEvent& evt) {
+    return read_event(m_reader, evt);
+}
+
+std::streamoff AsciiEventSource::offset() const {
+    return resume_offset(m_reader);
+}
+
+const std::vector<std::string>& AsciiEventSource::weight_names() const {
+    return m_reader.weight_names;
+}
+
+void AsciiEventSource::report(std::ostream& os) const {
+    ::report(m_reader, os);
+}
+
+bool AsciiEventSource::failed() const {
+    return m_is->bad();
+}
+
+IndexedEventSource::IndexedEventSource(std::unique_ptr<std::istream> is)
+    : AsciiEventSource(std::move(is)) {
+    m_is->clear();
+    m_is->seekg(0);
+
+    std::string line;
+    while (std::getline(*m_is, line)) {
+        if (line.compare(0, 2, "E ") == 0) {
+            m_index.push_back(m_end);
+        }
+        m_end += line.size() + 1;
+    }
+
+    seek(0);
+}
+
+std::size_t IndexedEventSource::size() const {
+    return m_index.size();
+}
+
+void IndexedEventSource::seek(std::size_t ievent) {
+    m_is->clear();
+    m_is->seekg(0);
+    m_reader = Reader{};
+    open_reader(*m_is, m_reader,
+            ievent < m_index.size() ? m_index[ievent] : m_end);
+}
+
+PipeEventSource::PipeEventSource(std::unique_ptr<PipeIstream> is)
+    : AsciiEventSource(std::move(is)),
+      m_pipe(static_cast<const PipeIstream*>(m_is)) {
+}
+
+void PipeEventSource::report(std::ostream& os) const {
+    AsciiEventSource::report(os);
+
+    const auto& buf = m_pipe->buf();
+    const auto stats = buf.stats();
+    const double mib = 1 << 20;
+    os << "Read " << stats.bytes / mib << " MiB in " << stats.reads
+       << " reads, at most " << stats.max_filled << " of "
+       << buf.n_buffers() << " buffers of " << buf.buffer_size() / mib
+       << " MiB were waiting to be parsed.\n";
+    os << "  Writer blocked by the parser: " << stats.stalls << " times, "
+       << stats.stalled << " s.\n";
+    os << "  Parser waiting for the writer: " << stats.starves << " times, "
+       << stats.starved << " s.\n";
+    if (stats.error != 0) {
+        os << "Reading the pipe failed: " << std::strerror(stats.error)
+           << '\n';
+    }
+}
+
+bool PipeEventSource::failed() const {
+    return m_pipe->buf().stats().error != 0 || AsciiEventSource::failed();
+}
+
+void PipeEventSource::progress(std::ostream& os) const {
+    const auto stats = m_pipe->buf().stats();
+    os << "  stalls " << stats.stalls << "  starves " << stats.starves;
+}
+
+std::unique_ptr<IndexedEventSource> open_indexed_source(
+        const std::string& filename) {
+    auto is = std::make_unique<std::ifstream>(filename);
+    if (!*is) {
+        return nullptr;
+    }
+    return std::make_unique<IndexedEventSource>(std::move(is));
+}
+
+std::unique_ptr<EventSource> open_pipe_source(const std::string& filename,
+        std::size_t buffer_size, std::size_t n_buffers) {
+    int fd = 0;
+    bool owns_fd = false;
+    if (filename != "-") {
+        fd = open(filename.c_str(), O_RDONLY);
+        owns_fd = true;
+        if (fd < 0) {
+            return nullptr;
+        }
+    }
+
+    return std::make_unique<PipeEventSource>(std::make_unique<PipeIstream>(
+            fd, owns_fd, buffer_size, n_buffers));
+}
+
+std::unique_ptr<EventSource> open_event_source(const std::string& filename,
+        std::streamoff offset, std::size_t buffer_size,
+        std::size_t n_buffers) {
+    if (is_pipe(filename)) {
+        if (offset > 0) {
+            return nullptr;
+        }
+        return open_pipe_source(filename, buffer_size, n_buffers);
+    }
+
+    std::unique_ptr<std::istream> is;
+    if (ends_with(filename, ".gz")) {
+        is = std::make_unique<GzipIstream>(filename);
+    } else {
+        is = std::make_unique<std::ifstream>(filename);
+    }
+
+    if (!*is) {
+        return nullptr;
+    }
+    return std::make_unique<AsciiEventSource>(std::move(is), offset);
+}
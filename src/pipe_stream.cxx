@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "pipe_stream.h"
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+PipeStreambuf::PipeStreambuf(int fd, bool owns_fd, std::size_t buffer_size,
+        std::size_t n_buffers)
+    : m_fd(fd), m_owns_fd(owns_fd),
+      m_buffers(std::max<std::size_t>(n_buffers, 2),
+                std::vector<char>(std::max<std::size_t>(buffer_size, 1))),
+      m_sizes(m_buffers.size(), 0) {
+    for (std::size_t i = 0; i < m_buffers.size(); ++i) {
+        m_free.push_back(i);
+    }
+    m_thread = std::thread(&PipeStreambuf::run, this);
+}
+
+PipeStreambuf::~PipeStreambuf() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+
+    if (m_owns_fd) {
+        close(m_fd);
+    }
+}
+
+PipeStats PipeStreambuf::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::size_t PipeStreambuf::buffer_size() const {
+    return m_buffers.front().size();
+}
+
+std::size_t PipeStreambuf::n_buffers() const {
+    return m_buffers.size();
+}
+
+void PipeStreambuf::run() {
+    while (true) {
+        std::size_t i;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_free.empty()) {
+                ++m_stats.stalls;
+                auto t0 = std::chrono::steady_clock::now();
+                m_cv.wait(lock, [this] { return !m_free.empty() || m_stop; });
+                m_stats.stalled += seconds_since(t0);
+            }
+            if (m_stop) {
+                return;
+            }
+            i = m_free.front();
+            m_free.pop_front();
+        }
+
+        // Poll with a timeout so that the thread can be stopped while the
+        // writer is idle.
+        ssize_t n = -1;
+        int error = 0;
+        while (!m_stop) {
+            pollfd pfd{m_fd, POLLIN, 0};
+            int ready = poll(&pfd, 1, 100);
+            if (ready == 0 || (ready < 0 && errno == EINTR)) {
+                continue;
+            }
+            if (ready < 0) {
+                error = errno;
+                break;
+            }
+
+            n = read(m_fd, m_buffers[i].data(), m_buffers[i].size());
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                error = errno;
+            }
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (n <= 0) {
+            m_stats.error = error;
+            m_free.push_back(i);
+            m_eof = true;
+            m_cv.notify_all();
+            return;
+        }
+
+        m_sizes[i] = n;
+        m_filled.push_back(i);
+        m_stats.bytes += n;
+        ++m_stats.reads;
+        m_stats.max_filled = std::max(m_stats.max_filled, m_filled.size());
+        m_cv.notify_all();
+    }
+}
+
+PipeStreambuf::int_type PipeStreambuf::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_has_current) {
+        m_free.push_back(m_current);
+        m_has_current = false;
+        m_cv.notify_all();
+    }
+
+    if (m_filled.empty() && !m_eof) {
+        ++m_stats.starves;
+        auto t0 = std::chrono::steady_clock::now();
+        m_cv.wait(lock, [this] { return !m_filled.empty() || m_eof; });
+        m_stats.starved += seconds_since(t0);
+    }
+    if (m_filled.empty()) {
+        return traits_type::eof();
+    }
+
+    m_current = m_filled.front();
+    m_has_current = true;
+    m_filled.pop_front();
+
+    auto* data = m_buffers[m_current].data();
+    setg(data, data, data + m_sizes[m_current]);
+    return traits_type::to_int_type(*gptr());
+}
+
+PipeIstream::PipeIstream(int fd, bool owns_fd, std::size_t buffer_size,
+        std::size_t n_buffers)
+    : std::istream(nullptr), m_buf(fd, owns_fd, buffer_size, n_buffers) {
+    rdbuf(&m_buf);
+}
+
+const PipeStreambuf& PipeIstream::buf() const {
+    return m_buf;
+}
@@ -0,0 +1,81 @@
+#include "root_tree_sink.h"
+
+RootTreeSink::RootTreeSink(const std::string& filename,
+        const RootTreeOptions& options)
+    : m_options(options) {
+    m_resumed = make_output(filename, m_output, m_options);
+    if (!is_open()) {
+        return;
+    }
+
+    // Only checkpoints may write the tree header, otherwise entries beyond
+    // the last stored input offset would be converted twice on resume.
+    if (m_options.checkpoints || m_options.resume) {
+        m_output.tree->SetAutoSave(0);
+    }
+}
+
+RootTreeSink::~RootTreeSink() {
+    // Nothing is written here, so that an output abandoned on an error
+    // keeps the contents of its last checkpoint.
+    m_output.tree.reset();
+    m_output.file.reset();
+}
+
+void RootTreeSink::write(HepMC::GenEvent& evt) {
+    write(evt, {});
+}
+
+void RootTreeSink::write(HepMC::GenEvent& evt,
+        const std::vector<std::string>& weight_names) {
+    clear(m_output.event);
+    process_evt(evt, m_output.event, m_options.flat, m_options.euler_tour);
+    fill_weights(evt, weight_names, m_output, m_options.float_weights);
+    m_output.tree->Fill();
+}
+
+void RootTreeSink::report(std::ostream& os) const {
+    if (m_output.truncated_weights == 0) {
+        return;
+    }
+
+    os << m_output.truncated_weights << " event(s) had more than the "
+       << m_output.event.weight_values.size() << " weights stored in the "
+       << "fixed-width weights branch, the extra weights are only in "
+       << "weight_summary.\n";
+}
+
+void RootTreeSink::checkpoint(std::streamoff input_offset) {
+    ::checkpoint(m_output, input_offset);
+}
+
+bool RootTreeSink::is_open() const {
+    return m_output.file != nullptr;
+}
+
+bool RootTreeSink::resumed() const {
+    return m_resumed;
+}
+
+const std::string& RootTreeSink::mismatch() const {
+    return m_output.mismatch;
+}
+
+Long64_t RootTreeSink::entries() const {
+    return m_output.tree->GetEntries();
+}
+
+std::streamoff RootTreeSink::last_checkpoint() const {
+    return ::last_checkpoint(m_output);
+}
+
+void RootTreeSink::close() {
+    if (m_output.file == nullptr) {
+        return;
+    }
+
+    write_weight_summary(m_output);
+    m_output.file->Write("", TObject::kOverwrite);
+    m_output.tree.reset();
+    m_output.file.reset();
+}